@@ -18,36 +18,76 @@ struct ServiceInformation {
     let icon: UIImage?
 }
 
+/// Sends AppKinetics requests through GDServiceClient.
+struct GDServiceRequestSender: ServiceRequestSender {
+    
+    func send(to application: String,
+              service: String,
+              version: String,
+              method: String,
+              parameters: Any?,
+              attachments: [String]) throws -> String? {
+        var requestID: NSString?
+        try GDServiceClient.send(
+            to: application,
+            withService: service,
+            withVersion: version,
+            withMethod: method,
+            withParams: parameters,
+            withAttachments: attachments,
+            bringServiceToFront: .GDEPreferPeerInForeground,
+            requestID: &requestID
+        )
+        return requestID as String?
+    }
+    
+    func cancelRequest(_ requestID: String, toApplication application: String) -> Bool {
+        return GDServiceClient.cancelRequest(requestID, toApplication: application)
+    }
+}
+
 class BBDServiceClient: NSObject {
     
     private let good: GDiOS
     private let fileManager: GDFileManager
     private let serviceClient: GDServiceClient
+    private let requests: ServiceRequestTracker
     
-    init(good: GDiOS, fileManager: GDFileManager) {
+    // Provider lists keyed by service ID and version, rebuilt only after a services update
+    private var providersCache = [String: [ServiceInformation]]()
+    private let providersLock = NSLock()
+    
+    init(good: GDiOS, fileManager: GDFileManager, sender: ServiceRequestSender = GDServiceRequestSender()) {
         self.good = good
         self.fileManager = fileManager
         self.serviceClient = GDServiceClient()
+        self.requests = ServiceRequestTracker(sender: sender)
         super.init()
         self.serviceClient.delegate = self
     }
     
+    @discardableResult
     func performService(_ service: String,
                         version: String,
                         method: String,
                         address: String,
                         parameters: Any? = nil,
-                        attachments: [String] = []) throws {
-        try GDServiceClient.send(
-            to: address,
-            withService: service,
-            withVersion: version,
-            withMethod: method,
-            withParams: parameters,
-            withAttachments: attachments,
-            bringServiceToFront: .GDEPreferPeerInForeground,
-            requestID: nil
-        )
+                        attachments: [String] = [],
+                        timeout: TimeInterval? = nil,
+                        completion: ServiceRequestTracker.ResponseHandler? = nil) throws -> String? {
+        return try self.requests.send(to: address,
+                                      service: service,
+                                      version: version,
+                                      method: method,
+                                      parameters: parameters,
+                                      attachments: attachments,
+                                      timeout: timeout,
+                                      completion: completion)
+    }
+    
+    @discardableResult
+    func cancelRequest(_ requestID: String, toApplication application: String) -> Bool {
+        return self.requests.cancelRequest(requestID, toApplication: application)
     }
     
     func callService(
@@ -72,9 +112,7 @@ class BBDServiceClient: NSObject {
                 throw BlackBerryDynamicsError.serviceAppNotFound(service: service)
             }
         }
-        let existingAttachements = attachments.filter {
-            self.fileManager.fileExists(atPath: $0)
-        }
+        let existingAttachements = self.existingFiles(atPaths: attachments)
         
         try self.performService(service,
                                 version: version,
@@ -84,13 +122,33 @@ class BBDServiceClient: NSObject {
                                 attachments: existingAttachements)
     }
     
+    private func existingFiles(atPaths paths: [String]) -> [String] {
+        // Check each distinct path once, keeping the caller's order
+        var seen = Set<String>()
+        return paths.filter { seen.insert($0).inserted && self.fileManager.fileExists(atPath: $0) }
+    }
+    
     func listAppsFor(service: String, version: String? = nil) -> [ServiceInformation] {
+        let key = "\(service)|\(version ?? "")"
+        self.providersLock.lock()
+        defer { self.providersLock.unlock() }
+        if let cached = self.providersCache[key] {
+            return cached
+        }
         let providers = self.good.getServiceProviders(for: service, andVersion: version, andServiceType: .application)
-        return providers.map({ ServiceInformation(identifier: $0.identifier,
-                                                  address: $0.address,
-                                                  name: $0.name,
-                                                  version: $0.version,
-                                                  icon: $0.icon) })
+        let services = providers.map({ ServiceInformation(identifier: $0.identifier,
+                                                          address: $0.address,
+                                                          name: $0.name,
+                                                          version: $0.version,
+                                                          icon: $0.icon) })
+        self.providersCache[key] = services
+        return services
+    }
+    
+    func invalidateServiceProviders() {
+        self.providersLock.lock()
+        self.providersCache.removeAll()
+        self.providersLock.unlock()
     }
 }
 
@@ -98,6 +156,7 @@ extension BBDServiceClient: GDServiceClientDelegate {
     
     func gdServiceClientDidReceive(from application: String, withParams params: Any, withAttachments attachments: [String], correspondingToRequestID requestID: String) {
         debugPrint("Received from application: \(application). Params: \(params)")
+        self.requests.receive(ServiceResponse(application: application, params: params, attachments: attachments), forRequestID: requestID)
     }
 }
 
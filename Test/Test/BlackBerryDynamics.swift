@@ -14,6 +14,9 @@ public enum BlackBerryDynamicsError: LocalizedError {
     case auth(event: GDAppResultCode)
     case serviceAppNotFound(service: String)
     case desiredAppNotFound(app: String)
+    case serviceRequestTimedOut(requestID: String)
+    case serviceRequestCancelled(requestID: String)
+    case serviceRequestNotTracked(service: String)
     
     public var errorDescription: String? {
         switch self {
@@ -23,6 +26,12 @@ public enum BlackBerryDynamicsError: LocalizedError {
             return "No app found for service: \(service)"
         case .desiredAppNotFound(let app):
             return "Service app not found: \(app)"
+        case .serviceRequestTimedOut(let requestID):
+            return "Service request timed out: \(requestID)"
+        case .serviceRequestCancelled(let requestID):
+            return "Service request cancelled: \(requestID)"
+        case .serviceRequestNotTracked(let service):
+            return "No request ID returned for service: \(service)"
         }
     }
     
@@ -48,7 +57,7 @@ extension GDFileManager {
         return try? GDFileManager.getReadStream(path)
     }
     open override func outputStreamFor(fileAtPath path: String, append: Bool) -> OutputStream? {
-        return try? GDFileManager.getWriteStream(path, appendmode: true)
+        return try? GDFileManager.getWriteStream(path, appendmode: append)
     }
 }
 
@@ -82,7 +91,7 @@ extension BlackBerryDynamics: GDiOSDelegate {
         case .remoteSettingsUpdate:
             break // A change to application-related configuration or policy settings.
         case .servicesUpdate:
-            break // A change to services-related configuration.
+            self.serviceClient?.invalidateServiceProviders() // A change to services-related configuration.
         case .policyUpdate:
             if self.started {
                 NotificationCenter.default.post(name: NSNotification.Name(rawValue: "AppPolicyUpdated"), object: nil)
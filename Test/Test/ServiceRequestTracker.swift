@@ -0,0 +1,174 @@
+//
+//  ServiceRequestTracker.swift
+//  Test
+//
+//  Copyright © Future Workshops. All rights reserved.
+//
+
+import Foundation
+
+struct ServiceResponse {
+    let application: String
+    let params: Any
+    let attachments: [String]
+}
+
+/// The AppKinetics calls the tracker depends on, so the correlation logic can run without the SDK.
+protocol ServiceRequestSender {
+    func send(to application: String,
+              service: String,
+              version: String,
+              method: String,
+              parameters: Any?,
+              attachments: [String]) throws -> String?
+    func cancelRequest(_ requestID: String, toApplication application: String) -> Bool
+}
+
+/// Matches AppKinetics responses to the requests that caused them, with optional deadlines and cancellation.
+final class ServiceRequestTracker {
+
+    typealias ResponseHandler = (Result<ServiceResponse, Error>) -> Void
+
+    private struct PendingRequest {
+        let application: String
+        let completion: ResponseHandler
+        let timeout: DispatchWorkItem?
+    }
+
+    private let sender: ServiceRequestSender
+    private let responseQueue: DispatchQueue
+
+    private let lock = NSLock()
+    // Requests awaiting a response, keyed by AppKinetics request ID
+    private var pendingRequests = [String: PendingRequest]()
+    // Responses that arrived while their send had not yet returned an ID; only kept while a send is in flight
+    private var earlyResponses = [String: ServiceResponse]()
+    private var sendsInFlight = 0
+
+    init(sender: ServiceRequestSender, responseQueue: DispatchQueue = DispatchQueue(label: "ServiceRequestTracker.responses")) {
+        self.sender = sender
+        self.responseQueue = responseQueue
+    }
+
+    @discardableResult
+    func send(to application: String,
+              service: String,
+              version: String,
+              method: String,
+              parameters: Any?,
+              attachments: [String],
+              timeout: TimeInterval? = nil,
+              completion: ResponseHandler? = nil) throws -> String? {
+        self.lock.lock()
+        self.sendsInFlight += 1
+        self.lock.unlock()
+
+        // The SDK may do storage or network I/O here, so it is called without holding the lock
+        let requestID: String?
+        do {
+            requestID = try self.sender.send(to: application,
+                                             service: service,
+                                             version: version,
+                                             method: method,
+                                             parameters: parameters,
+                                             attachments: attachments)
+        } catch {
+            self.finishSend(requestID: nil, application: application, timeout: nil, completion: nil)
+            throw error
+        }
+
+        guard let identifier = requestID else {
+            self.finishSend(requestID: nil, application: application, timeout: nil, completion: nil)
+            if let completion = completion {
+                self.responseQueue.async {
+                    completion(.failure(BlackBerryDynamicsError.serviceRequestNotTracked(service: service)))
+                }
+            }
+            return nil
+        }
+        self.finishSend(requestID: identifier, application: application, timeout: timeout, completion: completion)
+        return identifier
+    }
+
+    /// Cancels a request through AppKinetics. The completion fails only if the SDK cancelled it;
+    /// once a request has been delivered its real response still resolves it.
+    @discardableResult
+    func cancelRequest(_ requestID: String, toApplication application: String) -> Bool {
+        guard self.sender.cancelRequest(requestID, toApplication: application) else { return false }
+        if let pending = self.removePendingRequest(requestID) {
+            self.responseQueue.async {
+                pending.completion(.failure(BlackBerryDynamicsError.serviceRequestCancelled(requestID: requestID)))
+            }
+        }
+        return true
+    }
+
+    func receive(_ response: ServiceResponse, forRequestID requestID: String) {
+        self.lock.lock()
+        let pending = self.pendingRequests.removeValue(forKey: requestID)
+        if pending == nil && self.sendsInFlight > 0 {
+            self.earlyResponses[requestID] = response
+        }
+        self.lock.unlock()
+
+        guard let request = pending else { return }
+        request.timeout?.cancel()
+        self.deliver(response, to: request.completion)
+    }
+
+    var pendingCount: Int {
+        self.lock.lock()
+        defer { self.lock.unlock() }
+        return self.pendingRequests.count
+    }
+
+    private func finishSend(requestID: String?, application: String, timeout: TimeInterval?, completion: ResponseHandler?) {
+        self.lock.lock()
+        self.sendsInFlight -= 1
+        let early = requestID.flatMap { self.earlyResponses.removeValue(forKey: $0) }
+        if let requestID = requestID, let completion = completion, early == nil {
+            self.pendingRequests[requestID] = PendingRequest(application: application,
+                                                             completion: completion,
+                                                             timeout: self.scheduleTimeout(timeout, for: requestID))
+        }
+        if self.sendsInFlight == 0 {
+            // Anything left belongs to requests sent without a completion
+            self.earlyResponses.removeAll()
+        }
+        self.lock.unlock()
+
+        if let response = early, let completion = completion {
+            self.deliver(response, to: completion)
+        }
+    }
+
+    private func scheduleTimeout(_ timeout: TimeInterval?, for requestID: String) -> DispatchWorkItem? {
+        guard let timeout = timeout else { return nil }
+        let item = DispatchWorkItem { [weak self] in
+            // The deadline always fails the caller; a late response then finds no entry and is dropped
+            guard let self = self, let pending = self.removePendingRequest(requestID) else { return }
+            _ = self.sender.cancelRequest(requestID, toApplication: pending.application)
+            pending.completion(.failure(BlackBerryDynamicsError.serviceRequestTimedOut(requestID: requestID)))
+        }
+        self.responseQueue.asyncAfter(deadline: .now() + timeout, execute: item)
+        return item
+    }
+
+    private func removePendingRequest(_ requestID: String) -> PendingRequest? {
+        self.lock.lock()
+        let pending = self.pendingRequests.removeValue(forKey: requestID)
+        self.lock.unlock()
+        pending?.timeout?.cancel()
+        return pending
+    }
+
+    private func deliver(_ response: ServiceResponse, to completion: @escaping ResponseHandler) {
+        self.responseQueue.async {
+            if let error = response.params as? NSError {
+                completion(.failure(error))
+            } else {
+                completion(.success(response))
+            }
+        }
+    }
+}
@@ -0,0 +1,216 @@
+//
+//  ServiceRequestTrackerTests.swift
+//  TestTests
+//
+//  Copyright © Future Workshops. All rights reserved.
+//
+
+import XCTest
+@testable import Test
+
+private final class FakeServiceRequestSender: ServiceRequestSender {
+
+    private let lock = NSLock()
+    private var nextID = 0
+    private var cancelled = [String]()
+
+    var returnsRequestID = true
+    var cancelSucceeds = true
+    // Runs on the sending thread after the ID is assigned and before send returns
+    var onSend: ((String) -> Void)?
+
+    var cancelledIDs: [String] {
+        self.lock.lock()
+        defer { self.lock.unlock() }
+        return self.cancelled
+    }
+
+    func send(to application: String, service: String, version: String, method: String, parameters: Any?, attachments: [String]) throws -> String? {
+        guard self.returnsRequestID else { return nil }
+        self.lock.lock()
+        self.nextID += 1
+        let requestID = "request-\(self.nextID)"
+        self.lock.unlock()
+        self.onSend?(requestID)
+        return requestID
+    }
+
+    func cancelRequest(_ requestID: String, toApplication application: String) -> Bool {
+        self.lock.lock()
+        self.cancelled.append(requestID)
+        self.lock.unlock()
+        return self.cancelSucceeds
+    }
+}
+
+class ServiceRequestTrackerTests: XCTestCase {
+
+    private let application = "com.example.provider"
+    private var sender: FakeServiceRequestSender!
+    private var responseQueue: DispatchQueue!
+    private var tracker: ServiceRequestTracker!
+
+    override func setUp() {
+        super.setUp()
+        self.sender = FakeServiceRequestSender()
+        self.responseQueue = DispatchQueue(label: "ServiceRequestTrackerTests.responses")
+        self.tracker = ServiceRequestTracker(sender: self.sender, responseQueue: self.responseQueue)
+    }
+
+    override func tearDown() {
+        self.tracker = nil
+        self.sender = nil
+        self.responseQueue = nil
+        super.tearDown()
+    }
+
+    private func send(timeout: TimeInterval? = nil, completion: ServiceRequestTracker.ResponseHandler? = nil) throws -> String? {
+        return try self.tracker.send(to: self.application,
+                                     service: "com.example.service",
+                                     version: "1.0.0.0",
+                                     method: "run",
+                                     parameters: nil,
+                                     attachments: [],
+                                     timeout: timeout,
+                                     completion: completion)
+    }
+
+    private func response(_ params: Any = ["ok": true]) -> ServiceResponse {
+        return ServiceResponse(application: self.application, params: params, attachments: [])
+    }
+
+    private func flushResponses() {
+        self.responseQueue.sync {}
+    }
+
+    func testResponseAfterRegistrationCompletesRequest() throws {
+        let completed = self.expectation(description: "completed")
+        let requestID = try XCTUnwrap(self.send { result in
+            XCTAssertNotNil(try? result.get())
+            completed.fulfill()
+        })
+        self.tracker.receive(self.response(), forRequestID: requestID)
+        self.wait(for: [completed], timeout: 1)
+        XCTAssertEqual(self.tracker.pendingCount, 0)
+    }
+
+    func testResponseBeforeRegistrationCompletesRequest() throws {
+        let completed = self.expectation(description: "completed")
+        self.sender.onSend = { [unowned self] requestID in
+            self.tracker.receive(self.response(), forRequestID: requestID)
+        }
+        _ = try self.send { result in
+            XCTAssertNotNil(try? result.get())
+            completed.fulfill()
+        }
+        self.wait(for: [completed], timeout: 1)
+        XCTAssertEqual(self.tracker.pendingCount, 0)
+    }
+
+    func testErrorResponseFailsRequest() throws {
+        let completed = self.expectation(description: "completed")
+        let requestID = try XCTUnwrap(self.send { result in
+            XCTAssertNil(try? result.get())
+            completed.fulfill()
+        })
+        self.tracker.receive(self.response(NSError(domain: "GDServicesErrorDomain", code: 1)), forRequestID: requestID)
+        self.wait(for: [completed], timeout: 1)
+    }
+
+    func testTimeoutAfterDeliveryFailsRequestAndDropsLateResponse() throws {
+        self.sender.cancelSucceeds = false
+        let completed = self.expectation(description: "completed")
+        let requestID = try XCTUnwrap(self.send(timeout: 0.05) { result in
+            guard case .failure(BlackBerryDynamicsError.serviceRequestTimedOut(_)) = result else {
+                return XCTFail("Expected a timeout, got \(result)")
+            }
+            completed.fulfill()
+        })
+        self.wait(for: [completed], timeout: 1)
+        XCTAssertEqual(self.sender.cancelledIDs, [requestID])
+        XCTAssertEqual(self.tracker.pendingCount, 0)
+
+        // Fulfilling the expectation a second time would fail the test
+        self.tracker.receive(self.response(), forRequestID: requestID)
+        self.flushResponses()
+    }
+
+    func testCancelBeforeDeliveryFailsRequest() throws {
+        let completed = self.expectation(description: "completed")
+        let requestID = try XCTUnwrap(self.send { result in
+            guard case .failure(BlackBerryDynamicsError.serviceRequestCancelled(_)) = result else {
+                return XCTFail("Expected a cancellation, got \(result)")
+            }
+            completed.fulfill()
+        })
+        XCTAssertTrue(self.tracker.cancelRequest(requestID, toApplication: self.application))
+        self.wait(for: [completed], timeout: 1)
+        XCTAssertEqual(self.tracker.pendingCount, 0)
+    }
+
+    func testCancelRacingDeliveredResponseKeepsRealResponse() throws {
+        self.sender.cancelSucceeds = false
+        let completed = self.expectation(description: "completed")
+        let requestID = try XCTUnwrap(self.send { result in
+            XCTAssertNotNil(try? result.get())
+            completed.fulfill()
+        })
+        let cancelled = DispatchGroup()
+        DispatchQueue.global().async(group: cancelled) {
+            XCTAssertFalse(self.tracker.cancelRequest(requestID, toApplication: self.application))
+        }
+        self.tracker.receive(self.response(), forRequestID: requestID)
+        cancelled.wait()
+        self.wait(for: [completed], timeout: 1)
+        XCTAssertEqual(self.tracker.pendingCount, 0)
+    }
+
+    func testCancelForwardsRequestSentWithoutCompletion() throws {
+        let requestID = try XCTUnwrap(self.send())
+        XCTAssertTrue(self.tracker.cancelRequest(requestID, toApplication: self.application))
+        XCTAssertEqual(self.sender.cancelledIDs, [requestID])
+    }
+
+    func testMissingRequestIDFailsCompletion() throws {
+        self.sender.returnsRequestID = false
+        let completed = self.expectation(description: "completed")
+        let requestID = try self.send { result in
+            guard case .failure(BlackBerryDynamicsError.serviceRequestNotTracked(_)) = result else {
+                return XCTFail("Expected an untracked request, got \(result)")
+            }
+            completed.fulfill()
+        }
+        XCTAssertNil(requestID)
+        self.wait(for: [completed], timeout: 1)
+    }
+
+    func testConcurrentRequestsCompleteExactlyOnce() {
+        let requestCount = 10_000
+        self.sender.cancelSucceeds = false
+        // About a third of the requests are answered before their send returns
+        self.sender.onSend = { [unowned self] requestID in
+            if requestID.hasSuffix("0") || requestID.hasSuffix("2") || requestID.hasSuffix("4") {
+                self.tracker.receive(self.response(), forRequestID: requestID)
+            }
+        }
+        let completed = self.expectation(description: "completed")
+        completed.expectedFulfillmentCount = requestCount
+
+        DispatchQueue.concurrentPerform(iterations: requestCount) { index in
+            let requestID = try? self.send(timeout: 30) { result in
+                XCTAssertNotNil(try? result.get())
+                completed.fulfill()
+            }
+            guard let identifier = requestID else { return XCTFail("Missing request ID") }
+            if index % 3 == 0 {
+                self.tracker.cancelRequest(identifier, toApplication: self.application)
+            }
+            DispatchQueue.global().async {
+                self.tracker.receive(self.response(), forRequestID: identifier)
+            }
+        }
+
+        self.wait(for: [completed], timeout: 30)
+        XCTAssertEqual(self.tracker.pendingCount, 0)
+    }
+}